@@ -4,6 +4,10 @@
 
 #include "RttrSolBinder.h"
 
+#include <map>
+#include <set>
+#include <string>
+
 
 /*! \brief Allocates from global memory (NOTE: does not currently align memory) */
 struct GlobalAllocator
@@ -60,7 +64,10 @@ struct GlobalAllocator
 *	Aligns all memory to 8 bytes
 *	Has a min allocation of 64 bytes
 *	Puts all free'd blocks on a free list.
-*	Falls back to GlobalAllocator when out of memory. */
+*	Falls back to GlobalAllocator when out of memory, small blocks from there are recycled through
+*	the free list as well, so short-lived userdata and their tables stop hitting the global heap.
+*	Up to MAX_FREE_BLOCKS (256KB) of those heap blocks are kept for the life of the allocator after
+*	a peak, the rest go back to the heap. Not thread safe, every state using it must share a thread. */
 struct ArenaAllocator
 {
     void* m_begin;
@@ -69,6 +76,7 @@ struct ArenaAllocator
 
     static constexpr int ALIGNMENT = 8;
     static constexpr int MIN_BLOCK_SIZE = ALIGNMENT * 8;
+    static constexpr int MAX_FREE_BLOCKS = 4096;
 
     struct FreeList
     {
@@ -76,6 +84,7 @@ struct ArenaAllocator
     };
 
     FreeList* m_freeListHead;
+    int m_freeListSize;
     GlobalAllocator m_globalAllocator;
 
     ArenaAllocator(void* begin, void* end) :
@@ -88,6 +97,7 @@ struct ArenaAllocator
     void Reset()
     {
         m_freeListHead = nullptr;
+        m_freeListSize = 0;
         m_curr = static_cast<char*>(m_begin);
     }
 
@@ -109,6 +119,7 @@ struct ArenaAllocator
             //printf("-- allocated from the freelist --\n");
             void* ptr = m_freeListHead;
             m_freeListHead = m_freeListHead->m_next;
+            m_freeListSize--;
             return ptr;
         }
         else
@@ -123,7 +134,7 @@ struct ArenaAllocator
             }
             else
             {
-                return m_globalAllocator.Allocate(sizeBytes);
+                return m_globalAllocator.Allocate(allocatedBytes);
             }
         }
     }
@@ -131,9 +142,10 @@ struct ArenaAllocator
     void DeAllocate(void* ptr, size_t osize)
     {
         assert(ptr != nullptr);		//can't decallocate null!!!
-        if (ptr >= m_begin && ptr <= m_end)
+        size_t allocatedBytes = SizeToAllocate(osize);
+        bool isArenaBlock = ptr >= m_begin && ptr <= m_end;
+        if (isArenaBlock || (allocatedBytes == MIN_BLOCK_SIZE && m_freeListSize < MAX_FREE_BLOCKS))
         {
-            size_t allocatedBytes = SizeToAllocate(osize);
             //printf("DeAllocated %d bytes\n", (int)allocatedBytes);
             if (allocatedBytes >= MIN_BLOCK_SIZE)
             {
@@ -141,6 +153,7 @@ struct ArenaAllocator
                 FreeList* newHead = static_cast<FreeList*>(ptr);
                 newHead->m_next = m_freeListHead;
                 m_freeListHead = newHead;
+                m_freeListSize++;
             }
         }
         else
@@ -191,6 +204,11 @@ constexpr int POOL_SIZE = 1024 * 10;
 char memory[POOL_SIZE];
 ArenaAllocator pool(memory, &memory[POOL_SIZE - 1]);
 
+void* LuaPoolAlloc(void* /*ud*/, void* ptr, size_t osize, size_t nsize)
+{
+    return ArenaAllocator::l_alloc(&pool, ptr, osize, nsize);
+}
+
 
 int CreateUserDatumFromVariant( lua_State* L, const rttr::variant& v );
 
@@ -213,6 +231,26 @@ int ToLua( lua_State* L, rttr::variant& result )
             lua_pushnumber(L, result.get_value<short>());
             numberOfReturnValues++;
         }
+        else if (result.is_type<float>())
+        {
+            lua_pushnumber(L, result.get_value<float>());
+            numberOfReturnValues++;
+        }
+        else if (result.is_type<double>())
+        {
+            lua_pushnumber(L, result.get_value<double>());
+            numberOfReturnValues++;
+        }
+        else if (result.is_type<bool>())
+        {
+            lua_pushboolean(L, result.get_value<bool>());
+            numberOfReturnValues++;
+        }
+        else if (result.is_type<std::string>())
+        {
+            lua_pushstring(L, result.get_value<std::string>().c_str());
+            numberOfReturnValues++;
+        }
         else if ( result.get_type().is_class() || result.get_type().is_pointer() )
         {
             numberOfReturnValues += CreateUserDatumFromVariant( L, result );
@@ -227,6 +265,44 @@ int ToLua( lua_State* L, rttr::variant& result )
     return numberOfReturnValues;
 }
 
+/*! \brief Key set in every metatable the binder creates, telling its userdata apart from sol's or io's */
+const char* const BOUND_METATABLE_KEY = "__rttr";
+
+/*! \return the variant held by the userdatum at #idx, or nullptr if it isn't a userdatum created by the binder */
+rttr::variant* ToBoundVariant(lua_State* L, int idx)
+{
+    if (lua_type(L, idx) != LUA_TUSERDATA || lua_getmetatable(L, idx) == 0)
+    {
+        return nullptr;
+    }
+    lua_pushstring(L, BOUND_METATABLE_KEY);
+    bool isBound = lua_rawget(L, -2) != LUA_TNIL;
+    lua_pop(L, 2);
+    return isBound ? (rttr::variant*)lua_touserdata(L, idx) : nullptr;
+}
+
+/*! \return the Lua number at #idx converted to #nativeType, or an invalid variant if #nativeType isn't numeric */
+rttr::variant NumberToVariant(lua_State* L, int idx, const rttr::type& nativeType)
+{
+    if (nativeType == rttr::type::get<float>())
+    {
+        return (float)lua_tonumber(L, idx);
+    }
+    else if (nativeType == rttr::type::get<double>())
+    {
+        return (double)lua_tonumber(L, idx);
+    }
+    else if (nativeType == rttr::type::get<int>())
+    {
+        return (int)lua_tonumber(L, idx);
+    }
+    else if (nativeType == rttr::type::get<short>())
+    {
+        return (short)lua_tonumber(L, idx);
+    }
+    return rttr::variant();
+}
+
 /*! \brief Invoke #methodToInvoke on #object, passing the arguments to the method from Lua and leave the result on the Lua stack.
 *	- Assumes that the top of the stack downwards is filled with the parameters to the method we are invoking.
 *	- To call a free function pass rttr::instance = {} as #object
@@ -248,13 +324,8 @@ int InvokeMethod( lua_State* L, rttr::method& methodToInvoke, rttr::instance& ob
             methodToInvoke.get_name().to_string().c_str(), numNativeArgs, numLuaArgs);
         assert(numLuaArgs == numNativeArgs);
     }
-    union PassByValue
-    {
-        int intVal;
-        short shortVal;
-    };
-
-    std::vector<PassByValue> pbv(numNativeArgs);
+    //numbers converted to the parameter types, rttr::argument only refers to them
+    std::vector<rttr::variant> numbers(numNativeArgs);
     std::vector<rttr::argument> nativeArgs(numNativeArgs);
     auto nativeParamsIt = nativeParams.begin();
     for (int i = 0; i < numLuaArgs; i++, nativeParamsIt++)
@@ -265,22 +336,29 @@ int InvokeMethod( lua_State* L, rttr::method& methodToInvoke, rttr::instance& ob
         switch (luaType)
         {
             case LUA_TNUMBER:
-                if (nativeParamType == rttr::type::get<int>())
+                numbers[i] = NumberToVariant(L, luaArgIdx, nativeParamType);
+                if (numbers[i].is_valid() == false)
                 {
-                    pbv[i].intVal = (int)lua_tonumber(L, luaArgIdx);
-                    nativeArgs[i] = pbv[i].intVal;
+                    luaL_error(L, "Cannot pass a number as parameter %d of type '%s' when calling '%s'",
+                        i,
+                        nativeParamType.get_name().to_string().c_str(),
+                        methodToInvoke.get_name().to_string().c_str());
                 }
-                else if (nativeParamType == rttr::type::get<short>())
-                {
-                    pbv[i].shortVal = (short)lua_tonumber(L, luaArgIdx);
-                    nativeArgs[i] = pbv[i].shortVal;
-                }
-                else
+                nativeArgs[i] = numbers[i];
+                break;
+            case LUA_TUSERDATA:
+            {
+                //pass the userdatum's variant straight through, rttr checks it against the parameter type
+                rttr::variant* ud = ToBoundVariant(L, luaArgIdx);
+                if (ud == nullptr)
                 {
-                    printf("unrecognised parameter type '%s'\n", nativeParamType.get_name().to_string().c_str());
-                    assert(false);
+                    luaL_error(L, "Parameter %d is a userdatum not bound from rttr when calling '%s'",
+                        i,
+                        methodToInvoke.get_name().to_string().c_str());
                 }
+                nativeArgs[i] = *ud;
                 break;
+            }
             default:
                 luaL_error(L, "Don't know this lua type '%s', parameter %d when calling '%s'",
                     lua_typename(L, luaType),
@@ -326,27 +404,34 @@ int CreateUserDatumFromVariant( lua_State* L, const rttr::variant& v )
     luaL_getmetatable( L, MetaTableName( v.get_type() ).c_str() );
     lua_setmetatable( L, userDatumStackIndex );
 
-    lua_newtable( L );
-    lua_setuservalue( L, userDatumStackIndex );
-
+    //the uservalue table is created on the first write in NewIndexUserDatum
     return 1;	//return the userdatum
 }
 
+bool CanSkipFinalizer( const rttr::type& t );
+
 int CreateUserDatum(lua_State* L)
 {
     const char* typeName = (const char*)lua_tostring(L, lua_upvalueindex(1));
     rttr::type typeToCreate = rttr::type::get_by_name(typeName);
 
+    rttr::variant created = typeToCreate.create();
+    rttr::type createdType = created.get_type();
+    bool isTOrPointer = createdType == typeToCreate || (createdType.is_pointer() && createdType.get_raw_type() == typeToCreate);
+    if (isTOrPointer == false && CanSkipFinalizer(typeToCreate))
+    {
+        //T's metatable has no __gc, e.g. the std::shared_ptr of an as_std_shared_ptr constructor would never be released
+        luaL_error(L, "'%s' is tagged TriviallyDestructible but its constructor creates a '%s', register it as_object or as_raw_ptr",
+            typeName, createdType.get_name().to_string().c_str());
+    }
+
     void* ud = lua_newuserdata(L, sizeof(rttr::variant) );
-    new (ud) rttr::variant(typeToCreate.create());
+    new (ud) rttr::variant(std::move(created));
     //rttr::variant& variant = *(rttr::variant*)ud;
 
     luaL_getmetatable(L, MetaTableName(typeToCreate).c_str());
     lua_setmetatable(L, 1);
 
-    lua_newtable(L);
-    lua_setuservalue(L, 1);
-
     return 1;	//return the userdatum
 }
 
@@ -370,6 +455,249 @@ int InvokeFuncOnUserDatum(lua_State* L)
     return InvokeMethod(L, m, object);
 }
 
+/*! \brief Invoke the operator method #m on the userdatum at #selfIdx, passing the value at #operandIdx as its operand.
+*	- Userdata operands are handed to the method straight from their variant, without going through InvokeMethod.
+*	- Methods without parameters (e.g. __len) ignore the operand Lua passes them.
+* \return the result of the method */
+rttr::variant InvokeOperator(lua_State* L, const rttr::method& m, int selfIdx = 1, int operandIdx = 2)
+{
+    rttr::variant* selfUD = ToBoundVariant(L, selfIdx);
+    if (selfUD == nullptr)
+    {
+        luaL_error(L, "Expected a bound userdatum as the first operand of native operator '%s'", m.get_name().to_string().c_str());
+    }
+
+    rttr::variant& self = *selfUD;
+    rttr::instance object(self);
+    rttr::array_range<rttr::parameter_info> nativeParams = m.get_parameter_infos();
+    if (nativeParams.empty())
+    {
+        return m.invoke(object);
+    }
+
+    rttr::variant number;
+    rttr::variant* operand = &number;
+    int luaType = lua_type(L, operandIdx);
+    switch (luaType)
+    {
+        case LUA_TUSERDATA:
+            operand = ToBoundVariant(L, operandIdx);
+            if (operand == nullptr)
+            {
+                luaL_error(L, "Expected a bound userdatum as the operand of native operator '%s'", m.get_name().to_string().c_str());
+            }
+            break;
+        case LUA_TNUMBER:
+            number = NumberToVariant(L, operandIdx, nativeParams.begin()->get_type());
+            if (number.is_valid() == false)
+            {
+                luaL_error(L, "Cannot pass a number to native operator '%s' expecting '%s'",
+                    m.get_name().to_string().c_str(),
+                    nativeParams.begin()->get_type().get_name().to_string().c_str());
+            }
+            break;
+        default:
+            luaL_error(L, "Don't know this lua type '%s' as an operand of native operator '%s'",
+                lua_typename(L, luaType),
+                m.get_name().to_string().c_str());
+            break;
+    }
+    return m.invoke(object, *operand);
+}
+
+/*! \brief Metamethod trampoline for __sub and __len, upvalue 1 is the rttr::method to call */
+int CallMetaMethod(lua_State* L)
+{
+    const rttr::method& m = *(rttr::method*)lua_touserdata(L, lua_upvalueindex(1));
+    rttr::variant result = InvokeOperator(L, m);
+    return ToLua(L, result);
+}
+
+/*! \brief Metamethod trampoline for __add and __mul, upvalue 1 is the rttr::method to call.
+*	Lua passes the number first for 2 * v, so the operands are swapped when only the second one is a userdatum. */
+int CallCommutativeMetaMethod(lua_State* L)
+{
+    const rttr::method& m = *(rttr::method*)lua_touserdata(L, lua_upvalueindex(1));
+    bool swapOperands = lua_type(L, 1) != LUA_TUSERDATA && lua_type(L, 2) == LUA_TUSERDATA;
+    rttr::variant result = swapOperands ? InvokeOperator(L, m, 2, 1) : InvokeOperator(L, m);
+    return ToLua(L, result);
+}
+
+/*! \brief Metamethod trampoline for __eq, upvalue 1 is the rttr::method to call.
+*	Lua calls __eq for any two full userdata, operands the method can't take compare unequal. */
+int CallEqMetaMethod(lua_State* L)
+{
+    const rttr::method& m = *(rttr::method*)lua_touserdata(L, lua_upvalueindex(1));
+    rttr::variant* self = ToBoundVariant(L, 1);
+    rttr::variant* operand = ToBoundVariant(L, 2);
+    rttr::array_range<rttr::parameter_info> nativeParams = m.get_parameter_infos();
+    if (self == nullptr || operand == nullptr || nativeParams.size() != 1 ||
+        self->get_type().get_raw_type().is_derived_from(m.get_declaring_type()) == false ||
+        operand->get_type() != nativeParams.begin()->get_type())
+    {
+        lua_pushboolean(L, false);
+        return 1;
+    }
+
+    rttr::variant result = InvokeOperator(L, m);
+    if (result.is_valid() == false)
+    {
+        luaL_error(L, "unable to compare with native method '%s'", m.get_name().to_string().c_str());
+    }
+    lua_pushboolean(L, result.to_bool());
+    return 1;
+}
+
+/*! \brief Metamethod trampoline for __lt, upvalue 1 is the rttr::method to call */
+int CallCompareMetaMethod(lua_State* L)
+{
+    const rttr::method& m = *(rttr::method*)lua_touserdata(L, lua_upvalueindex(1));
+    rttr::variant result = InvokeOperator(L, m);
+    if (result.is_valid() == false)
+    {
+        luaL_error(L, "unable to compare with native method '%s', are the operands of the same type?", m.get_name().to_string().c_str());
+    }
+    lua_pushboolean(L, result.to_bool());
+    return 1;
+}
+
+/*! \brief Metamethod trampoline for __tostring, upvalue 1 is the rttr::method to call */
+int CallToStringMetaMethod(lua_State* L)
+{
+    const rttr::method& m = *(rttr::method*)lua_touserdata(L, lua_upvalueindex(1));
+    rttr::variant result = InvokeOperator(L, m);
+    bool ok = false;
+    std::string str = result.to_string(&ok);
+    if (ok == false)
+    {
+        luaL_error(L, "native method '%s' bound as __tostring didn't return a string", m.get_name().to_string().c_str());
+    }
+    lua_pushstring(L, str.c_str());
+    return 1;
+}
+
+/*! \brief Property writes from Lua on one type tagged LuaMetaKey::TrackChanges.
+*	Each (object, property) is only logged once until the next DrainLuaChanges. */
+struct LuaChangeLog
+{
+    LuaObjectAddress address = nullptr;
+    std::vector<LuaPropertyChange> changes;
+    std::set<std::pair<void*, rttr::string_view>> written;
+};
+
+std::map<rttr::type, LuaChangeLog> changeLogs;
+
+/*! \brief Logs a write of #p on the object held by #ud to #changeLog, which may be nullptr for untracked types.
+*	Only native objects held by pointer are logged, a Lua owned one can be collected and its block reused before the drain. */
+void RecordChange(LuaChangeLog* changeLog, const rttr::variant& ud, const rttr::property& p)
+{
+    if (changeLog != nullptr && ud.get_type().is_pointer())
+    {
+        void* object = changeLog->address(rttr::instance(ud));
+        if (changeLog->written.insert(std::make_pair(object, p.get_name())).second)
+        {
+            changeLog->changes.push_back({ object, p });
+        }
+    }
+}
+
+/*! \brief Pushes the change log NewIndexUserDatum and the _assign closures record writes to for #t, or nil if #t isn't tracked */
+void PushChangeLog( lua_State* L, const rttr::type& t )
+{
+    rttr::variant tag = t.get_metadata( LuaMetaKey::TrackChanges );
+    if ( tag.is_type<LuaObjectAddress>() )
+    {
+        LuaChangeLog& changeLog = changeLogs[t];
+        changeLog.address = tag.get_value<LuaObjectAddress>();
+        lua_pushlightuserdata( L, ( void* )&changeLog );
+    }
+    else
+    {
+        lua_pushnil( L );
+    }
+}
+
+/*! \brief In-place variant of an operator, e.g. v:add_assign(w).
+*	Stores the result back into the userdatum at index 1 and returns it, so no new userdatum is allocated.
+*	A userdatum holding a pointer has the result written through, property by property, into the native object.
+*	Upvalue 2 is the change log of tracked types, those writes are recorded like NewIndexUserDatum's. */
+int CallAssignMethod(lua_State* L)
+{
+    const rttr::method& m = *(rttr::method*)lua_touserdata(L, lua_upvalueindex(1));
+    rttr::variant result = InvokeOperator(L, m);
+    if (result.is_valid() == false)
+    {
+        luaL_error(L, "unable to assign the result of native method '%s'", m.get_name().to_string().c_str());
+    }
+
+    rttr::variant& self = *(rttr::variant*)lua_touserdata(L, 1);
+    if (self.get_type().is_pointer())
+    {
+        rttr::instance target(self);
+        for (auto& p : result.get_type().get_properties())
+        {
+            if (p.set_value(target, p.get_value(result)) == false)
+            {
+                luaL_error(L, "unable to write '%s' back when assigning the result of native method '%s'",
+                    p.get_name().to_string().c_str(), m.get_name().to_string().c_str());
+            }
+            RecordChange((LuaChangeLog*)lua_touserdata(L, lua_upvalueindex(2)), self, p);
+        }
+    }
+    else
+    {
+        self.swap(result);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/*! \brief Binds every method of #classType tagged with LuaMetaKey::MetaMethod as that metamethod on the metatable at #metaTableIdx.
+*	Add, Sub and Mul returning #classType also get a '<name>_assign' closure in the table at #inPlaceTableIdx. */
+void BindMetaMethods(lua_State* L, const rttr::type& classType, int metaTableIdx, int inPlaceTableIdx)
+{
+    for ( auto& method : classType.get_methods() )
+    {
+        rttr::variant tag = method.get_metadata( LuaMetaKey::MetaMethod );
+        if ( tag.is_type<LuaMetaMethod>() == false )
+        {
+            continue;
+        }
+
+        const char* metaMethodName = nullptr;
+        lua_CFunction trampoline = CallMetaMethod;
+        bool hasInPlace = false;
+        switch ( tag.get_value<LuaMetaMethod>() )
+        {
+            case LuaMetaMethod::Add: metaMethodName = "__add"; trampoline = CallCommutativeMetaMethod; hasInPlace = true; break;
+            case LuaMetaMethod::Sub: metaMethodName = "__sub"; hasInPlace = true; break;
+            case LuaMetaMethod::Mul: metaMethodName = "__mul"; trampoline = CallCommutativeMetaMethod; hasInPlace = true; break;
+            case LuaMetaMethod::Eq: metaMethodName = "__eq"; trampoline = CallEqMetaMethod; break;
+            case LuaMetaMethod::Lt: metaMethodName = "__lt"; trampoline = CallCompareMetaMethod; break;
+            case LuaMetaMethod::Len: metaMethodName = "__len"; break;
+            case LuaMetaMethod::ToString: metaMethodName = "__tostring"; trampoline = CallToStringMetaMethod; break;
+            default:
+                printf("unrecognised metamethod tag on '%s', not binding it\n", method.get_name().to_string().c_str());
+                continue;
+        }
+
+        void* methodUD = lua_newuserdata( L, sizeof( rttr::method ) );
+        new ( methodUD ) rttr::method( method );
+        lua_pushcclosure( L, trampoline, 1 );
+        lua_setfield( L, metaTableIdx, metaMethodName );
+
+        if ( hasInPlace && method.get_return_type() == classType )
+        {
+            const std::string assignName = method.get_name().to_string() + "_assign";
+            methodUD = lua_newuserdata( L, sizeof( rttr::method ) );
+            new ( methodUD ) rttr::method( method );
+            PushChangeLog( L, classType );
+            lua_pushcclosure( L, CallAssignMethod, 2 );
+            lua_setfield( L, inPlaceTableIdx, assignName.c_str() );
+        }
+    }
+}
+
 int IndexUserDatum(lua_State* L)
 {
     const char* typeName = (const char*)lua_tostring(L, lua_upvalueindex(1));
@@ -384,6 +712,14 @@ int IndexUserDatum(lua_State* L)
         luaL_error(L, "Expected a name of a native property or method when indexing native type '%s'", typeName);
     }
 
+    //in-place operators are bound once per type, upvalue 2
+    lua_pushvalue(L, 2);
+    if (lua_rawget(L, lua_upvalueindex(2)) != LUA_TNIL)
+    {
+        return 1;
+    }
+    lua_pop(L, 1);
+
     const char* fieldName = lua_tostring(L, 2);
     rttr::method m = typeInfo.get_method(fieldName);
     if (m.is_valid())
@@ -406,7 +742,10 @@ int IndexUserDatum(lua_State* L)
     }
 
     //if it's not a method or property then return the uservalue
-    lua_getuservalue(L, 1);
+    if (lua_getuservalue(L, 1) == LUA_TNIL)
+    {
+        return 1;   //nothing was ever written to this userdatum
+    }
     lua_pushvalue(L, 2);
     lua_gettable(L, -2);
     return 1;
@@ -433,49 +772,104 @@ int NewIndexUserDatum(lua_State* L)
     if (p.is_valid())
     {
         rttr::variant& ud = *(rttr::variant*)lua_touserdata(L, 1);
+        bool isSet = false;
         int luaType = lua_type(L, 3);
         switch (luaType)
         {
             case LUA_TNUMBER:
-                if (p.get_type() == rttr::type::get<int>())
-                {
-                    int val = (int)lua_tonumber(L, 3);
-                    assert( p.set_value(ud, val) );
-                }
-                else if (p.get_type() == rttr::type::get<short>())
-                {
-                    short val = (short)lua_tonumber(L, 3);
-                    assert(p.set_value(ud, val));
-                }
-                else
+            {
+                rttr::variant val = NumberToVariant(L, 3, p.get_type());
+                if (val.is_valid() == false)
                 {
                     luaL_error(L,
                         "Cannot set the value '%s' on this type '%s', we didn't recognise the native type '%s'",
                         fieldName, typeName, p.get_type().get_name().to_string().c_str() );
                 }
+                isSet = p.set_value(ud, val);
+                break;
+            }
+            case LUA_TUSERDATA:
+            {
+                //copies the value out of the operand's variant, rttr checks it against the property type
+                rttr::variant* value = ToBoundVariant(L, 3);
+                if (value == nullptr)
+                {
+                    luaL_error(L,
+                        "Cannot set the value '%s' on this type '%s' from a userdatum not bound from rttr",
+                        fieldName, typeName );
+                }
+                isSet = p.set_value(ud, *value);
                 break;
+            }
             default:
                 luaL_error(L,
                     "Cannot set the value '%s' on this type '%s', we didnt recognise the lua type '%s'",
                     fieldName, typeName, lua_typename(L, luaType) );
                 break;
         }
+        if (isSet == false)
+        {
+            luaL_error(L,
+                "Cannot set the value '%s' on this type '%s' from a '%s'",
+                fieldName, typeName, lua_typename(L, luaType) );
+        }
 
+        //upvalue 2 is the change log of types tagged LuaMetaKey::TrackChanges, nil otherwise
+        RecordChange((LuaChangeLog*)lua_touserdata(L, lua_upvalueindex(2)), ud, p);
         return 0;
     }
 
     //if it wasn't a property then set it as a uservalue
-    lua_getuservalue(L, 1);
+    if (lua_getuservalue(L, 1) == LUA_TNIL)
+    {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setuservalue(L, 1);
+    }
     lua_pushvalue(L, 2);
     lua_pushvalue(L, 3);
     lua_settable(L, -3);
     return 0;
 }
 
-bool BindRttrToSol(sol::state& state)
+std::vector<LuaPropertyChange> DrainLuaChanges(const rttr::type& t)
+{
+    std::vector<LuaPropertyChange> changes;
+    auto it = changeLogs.find(t);
+    if (it != changeLogs.end())
+    {
+        changes.swap(it->second.changes);
+        it->second.written.clear();
+    }
+    return changes;
+}
+
+/*! \return true if userdata of #t can be collected without running DestroyUserDatum,
+*	see LuaTriviallyDestructible for the value to tag the type with */
+bool CanSkipFinalizer( const rttr::type& t )
 {
-    lua_State* L = luaL_newstate();
-//    lua_State* L = state;
+    rttr::variant tag = t.get_metadata( LuaMetaKey::TriviallyDestructible );
+    return tag.is_type<bool>() && tag.get_value<bool>();
+}
+
+void SetLuaGcParams(lua_State* L, const LuaGcParams& params)
+{
+    if (params.pause > 0)
+    {
+        lua_gc(L, LUA_GCSETPAUSE, params.pause);
+    }
+    if (params.stepMul > 0)
+    {
+        lua_gc(L, LUA_GCSETSTEPMUL, params.stepMul);
+    }
+}
+
+bool BindRttrToSol(sol::state& state, const LuaGcParams& gcParams, bool skipTrivialFinalizers)
+{
+    lua_State* L = state;
+    int top = lua_gettop( L );
+    SetLuaGcParams( L, gcParams );
 
     lua_newtable( L );
     lua_pushvalue( L, -1 );
@@ -515,21 +909,37 @@ bool BindRttrToSol(sol::state& state)
 
             //create the metatable & metamethods for this type
             luaL_newmetatable( L, MetaTableName( classToRegister ).c_str() );
-            lua_pushstring( L, "__gc" );
-            lua_pushcfunction( L, DestroyUserDatum );
+            lua_pushstring( L, BOUND_METATABLE_KEY );
+            lua_pushboolean( L, 1 );
             lua_settable( L, -3 );
+            if ( skipTrivialFinalizers == false || CanSkipFinalizer( classToRegister ) == false )
+            {
+                lua_pushstring( L, "__gc" );
+                lua_pushcfunction( L, DestroyUserDatum );
+                lua_settable( L, -3 );
+            }
+
+            int metaTableIdx = lua_gettop( L );
+            lua_newtable( L );
+            int inPlaceTableIdx = lua_gettop( L );
+            BindMetaMethods( L, classToRegister, metaTableIdx, inPlaceTableIdx );
 
             lua_pushstring( L, "__index" );
             lua_pushstring( L, typeName );
-            lua_pushcclosure( L, IndexUserDatum, 1 );
-            lua_settable( L, -3 );
+            lua_pushvalue( L, inPlaceTableIdx );
+            lua_pushcclosure( L, IndexUserDatum, 2 );
+            lua_settable( L, metaTableIdx );
+            lua_pop( L, 1 );                                              //in-place table
 
             lua_pushstring( L, "__newindex" );
             lua_pushstring( L, typeName );
-            lua_pushcclosure( L, NewIndexUserDatum, 1 );
+            PushChangeLog( L, classToRegister );
+            lua_pushcclosure( L, NewIndexUserDatum, 2 );
             lua_settable( L, -3 );
+            lua_settop( L, top );
         }
     }
 
-    return L;
+    lua_settop( L, top );
+    return true;
 }
\ No newline at end of file
@@ -8,6 +8,87 @@
 #include <sol.hpp>
 #include <rttr/type>
 
-bool BindRttrToSol(sol::state& state);
+#include <type_traits>
+#include <vector>
+
+/*! \brief Keys of the rttr::metadata the binder reads off registered classes and methods */
+enum class LuaMetaKey
+{
+    MetaMethod,             //!< value is a LuaMetaMethod, binds the method as that Lua metamethod
+    TriviallyDestructible,  //!< class metadata, LuaTriviallyDestructible<T>() skips __gc for its userdata
+    TrackChanges,           //!< class metadata, LuaTrackChanges<T>() records property writes from Lua for DrainLuaChanges
+};
+
+/*! \brief Lua metamethods a registered method can be bound as, e.g.
+*	.method("add", &Vec::add)(rttr::metadata(LuaMetaKey::MetaMethod, LuaMetaMethod::Add))
+*	Add, Sub and Mul methods returning their own type also get an in-place "<name>_assign"
+*	that writes the result back into the receiving userdatum instead of allocating a new one.
+*	Userdata holding a pointer are written through to the native object, but rb.pos:add_assign(w)
+*	changes the copy rb.pos returned, use rb.pos = rb.pos + w to change rb. */
+enum class LuaMetaMethod
+{
+    Add,        //!< also called for 2 + v, the operands are swapped so the method sees v first
+    Sub,        //!< v - 2 only, not being commutative 2 - v raises an error
+    Mul,        //!< as Add, 2 * v calls the method on v
+    Eq,
+    Lt,
+    Len,
+    ToString,
+};
+
+/*! \brief Value for LuaMetaKey::TriviallyDestructible on T's registration.
+*	Only true when rttr::variant keeps a T in place and T has nothing to destroy, so that by value
+*	and raw pointer userdata of T can be collected without __gc. rttr::variant keeps at least a
+*	double in place, checking against that is conservative. A vptr from RTTR_ENABLE() is usually
+*	enough to make a small type too big. */
+template<typename T>
+constexpr bool LuaTriviallyDestructible()
+{
+    return std::is_trivially_destructible<T>::value && std::is_nothrow_move_constructible<T>::value &&
+        sizeof(T) <= sizeof(double) && alignof(T) <= alignof(double);
+}
+
+/*! \brief Incremental collector tuning for a Lua state, 0 keeps Lua's default.
+*	Lua 5.3 has no generational mode, a lower pause collects temporaries sooner, a higher stepMul does more work per step. */
+struct LuaGcParams
+{
+    int pause = 0;      //!< LUA_GCSETPAUSE, percent of heap growth before a new cycle starts
+    int stepMul = 0;    //!< LUA_GCSETSTEPMUL, collection speed relative to allocation
+};
+
+void SetLuaGcParams(lua_State* L, const LuaGcParams& params);
+
+/*! \brief Returns the address of the native object behind #object */
+using LuaObjectAddress = void* (*)(const rttr::instance& object);
+
+/*! \brief Value for LuaMetaKey::TrackChanges on T's registration */
+template<typename T>
+LuaObjectAddress LuaTrackChanges()
+{
+    return [](const rttr::instance& object) -> void* { return object.try_convert<T>(); };
+}
+
+/*! \brief A property written from Lua on a native object of a type tagged LuaMetaKey::TrackChanges.
+*	Only writes through userdata holding a pointer are logged, objects created by Lua aren't synced.
+*	rb.pos.x = 1 writes to the copy rb.pos returned and isn't logged, write rb.pos as a whole. */
+struct LuaPropertyChange
+{
+    void* object;               //!< the written object, e.g. static_cast<Rigidbody*>(object)
+    rttr::property property;
+};
+
+/*! \brief Moves out the writes recorded for #t since the last drain, once per (object, property) in the order Lua first made them */
+std::vector<LuaPropertyChange> DrainLuaChanges(const rttr::type& t);
+
+/*! \brief lua_Alloc drawing from the binder's ArenaAllocator, pass it when constructing the sol::state */
+void* LuaPoolAlloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+/*! \brief Sends #result to Lua, class types and pointers become userdata using the bound metatables
+* \return the number of values left on the Lua stack */
+int ToLua(lua_State* L, rttr::variant& result);
+
+/*! \brief Binds the global methods and classes registered with rttr into #state.
+*	#skipTrivialFinalizers false keeps __gc on types tagged LuaMetaKey::TriviallyDestructible, to measure what skipping saves. */
+bool BindRttrToSol(sol::state& state, const LuaGcParams& gcParams = LuaGcParams(), bool skipTrivialFinalizers = true);
 
 #endif //RTTR_SOL_LUA_TEST_RTTRSOLBINDER_H
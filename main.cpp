@@ -10,7 +10,9 @@
 
 #include "RttrSolBinder.h"
 
+#include <cstdlib>
 #include <iostream>
+#include <string>
 #include <math.h>
 
 static auto console = spdlog::stdout_color_mt("console");
@@ -34,9 +36,13 @@ public:
     float x {0.0f};
     float y {0.0f};
     const Vec add(const Vec& v) const { return Vec(x + v.x, y + v.y); }
+    const Vec sub(const Vec& v) const { return Vec(x - v.x, y - v.y); }
+    const Vec mul(float s) const { return Vec(x * s, y * s); }
+    bool equals(const Vec& v) const { return x == v.x && y == v.y; }
     float length() const { return sqrtf(x*x + y*y); }
+    std::string to_string() const { return "[" + std::to_string(x) + ", " + std::to_string(y) + "]"; }
 
-    RTTR_ENABLE()
+    // no RTTR_ENABLE(), Vec has no hierarchy and without a vptr it stays in place in an rttr::variant
 };
 
 class Rigidbody {
@@ -57,23 +63,73 @@ public:
 }
 
 using namespace test;
+
+// the allocator luaL_newstate uses, to compare LuaPoolAlloc against
+static void* HeapAlloc(void* /*ud*/, void* ptr, size_t /*osize*/, size_t nsize)
+{
+    if (nsize == 0)
+    {
+        free(ptr);
+        return nullptr;
+    }
+    return realloc(ptr, nsize);
+}
+
+// 1M v + w, each allocating a Vec userdatum. The worst 1000-op batch approximates the
+// longest GC pause, Lua doesn't expose step times.
+static void RunTempHeavyBench(const char* name, lua_Alloc alloc, bool skipTrivialFinalizers, const LuaGcParams& gcParams)
+{
+    sol::state lua(sol::default_at_panic, alloc);
+    lua.open_libraries(sol::lib::base, sol::lib::os, sol::lib::math);
+    BindRttrToSol(lua, gcParams, skipTrivialFinalizers);
+    lua["expectNoGc"] = skipTrivialFinalizers;
+    lua.script(R"(
+assert((getmetatable(Vec.new()).__gc == nil) == expectNoGc)
+local a, b = Vec.new(), Vec.new()
+a.x, a.y, b.x, b.y = 1, 2, 3, 4
+collectgarbage()
+local worst, peakKB, start = 0, 0, os.clock()
+for batch = 1, 1000 do
+    local t = os.clock()
+    for i = 1, 1000 do local c = a + b end
+    worst = math.max(worst, os.clock() - t)
+    peakKB = math.max(peakKB, collectgarbage("count"))
+end
+benchTime, benchWorst, benchPeakKB = os.clock() - start, worst, peakKB
+    )");
+    double time = lua["benchTime"];
+    double worst = lua["benchWorst"];
+    double peakKB = lua["benchPeakKB"];
+    console->info("bench {}: {:.3f}s, {:.2f} Mops/s, worst batch {:.3f}ms, peak heap {:.0f}KB",
+        name, time, 1.0 / time, worst * 1000.0, peakKB);
+}
+
+static_assert(LuaTriviallyDestructible<Vec>(), "Vec temporaries are expected to be collected without __gc");
+
 RTTR_REGISTRATION
 {
-    rttr::registration::class_<Vec>("Vec")
+    rttr::registration::class_<Vec>("Vec")(
+            rttr::metadata(LuaMetaKey::TriviallyDestructible, LuaTriviallyDestructible<Vec>()),
+            rttr::metadata(LuaMetaKey::TrackChanges, LuaTrackChanges<Vec>()))
+        .constructor<>()(rttr::policy::ctor::as_object)
         .property("x", &Vec::x)
         .property("y", &Vec::y)
-        .method("add", &Vec::add)
-        .method("length", &Vec::length)
+        .method("add", &Vec::add)(rttr::metadata(LuaMetaKey::MetaMethod, LuaMetaMethod::Add))
+        .method("sub", &Vec::sub)(rttr::metadata(LuaMetaKey::MetaMethod, LuaMetaMethod::Sub))
+        .method("mul", &Vec::mul)(rttr::metadata(LuaMetaKey::MetaMethod, LuaMetaMethod::Mul))
+        .method("equals", &Vec::equals)(rttr::metadata(LuaMetaKey::MetaMethod, LuaMetaMethod::Eq))
+        .method("length", &Vec::length)(rttr::metadata(LuaMetaKey::MetaMethod, LuaMetaMethod::Len))
+        .method("to_string", &Vec::to_string)(rttr::metadata(LuaMetaKey::MetaMethod, LuaMetaMethod::ToString))
     ;
 
-    rttr::registration::class_<Rigidbody>("Rigidbody")
+    rttr::registration::class_<Rigidbody>("Rigidbody")(rttr::metadata(LuaMetaKey::TrackChanges, LuaTrackChanges<Rigidbody>()))
         .property("pos", &Rigidbody::pos)
         .property("rot", &Rigidbody::rot)
         ;
 }
 
 
-int main() {
+int main(int argc, char** argv) {
     auto solTypeToString = [](sol::type solType) {
         switch (solType) {
             default:
@@ -91,8 +147,8 @@ int main() {
     };
 
     console->info("start rttr+sol+lua test...");
-    sol::state lua;
-    lua.open_libraries(sol::lib::base);
+    sol::state lua(sol::default_at_panic, LuaPoolAlloc);
+    lua.open_libraries(sol::lib::base, sol::lib::os, sol::lib::math);
 
     const char* showGlobal = R"(
 local function showGlobalTable()
@@ -111,6 +167,66 @@ showGlobalTable()
     console->info("----------------");
     lua.script(showGlobal);
 
+    console->info("---- rttr operators ----");
+    lua.script(R"(
+local a = Vec.new()
+a.x = 1
+a.y = 2
+local b = a + a
+assert(b.x == 2 and b.y == 4)
+assert(a * 2 == b and 2 * a == b)
+assert(b - a == a and a:sub(b) == a - b)
+assert(a:mul(2) == b and a:add(a) == b)
+assert(#a == a:length())
+print("a = " .. tostring(a))
+a:add_assign(a)
+assert(a == b and rawequal(a, b) == false)
+    )");
+
+    console->info("---- change tracking ----");
+    Rigidbody rb;
+    rttr::variant rbHandle = &rb;
+    ToLua(lua, rbHandle);
+    lua_setglobal(lua, "rb");
+    lua.script(R"(
+local step = Vec.new()
+step.x = 1
+for i = 1, 1000 do
+    rb.pos = rb.pos + step
+end
+rb.rot = step
+assert(rb.pos.x == 1000 and rb.rot.x == 1)
+assert(rb.pos ~= rb and (rb.pos == rb) == false)
+    )");
+    auto changes = DrainLuaChanges(rttr::type::get<Rigidbody>());
+    console->info("Rigidbody changes: {}, pos [{}, {}]", changes.size(), rb.pos.x, rb.pos.y);
+    assert(changes.size() == 2 && changes[0].object == &rb);
+    assert(changes[0].property == rttr::type::get<Rigidbody>().get_property("pos"));
+    assert(DrainLuaChanges(rttr::type::get<Rigidbody>()).empty());
+
+    Vec nativeVec(1.0f, 2.0f);
+    rttr::variant vecHandle = &nativeVec;
+    ToLua(lua, vecHandle);
+    lua_setglobal(lua, "nativeVec");
+    lua.script(R"(
+local step = Vec.new()
+step.x, step.y = 1, 1
+nativeVec:add_assign(step)
+nativeVec:add_assign(step)
+    )");
+    auto vecChanges = DrainLuaChanges(rttr::type::get<Vec>());
+    console->info("native Vec changes: {}, [{}, {}]", vecChanges.size(), nativeVec.x, nativeVec.y);
+    assert(nativeVec.x == 3.0f && nativeVec.y == 4.0f && vecChanges.size() == 2 && vecChanges[0].object == &nativeVec);
+
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+    {
+        // temporary heavy benchmark, every arm gets a fresh state
+        RunTempHeavyBench("pool, no __gc", LuaPoolAlloc, true, LuaGcParams());
+        RunTempHeavyBench("pool, __gc", LuaPoolAlloc, false, LuaGcParams());
+        RunTempHeavyBench("heap, no __gc", HeapAlloc, true, LuaGcParams());
+        RunTempHeavyBench("heap, __gc", HeapAlloc, false, LuaGcParams());
+        RunTempHeavyBench("pool, no __gc, eager gc", LuaPoolAlloc, true, { 100, 400 });
+    }
 
 //    Rigidbody::declare(lua);
 